@@ -45,6 +45,7 @@ pair<uint32_t*,ParsedADCEvent> ADCUnpacker::parse(uint32_t* begin,uint32_t* end)
 
   ParsedADCEvent event;
   int bad_flag = 0;
+  last_errors = 0;
   auto iter = begin;
   unpackHeader(iter, event);
   if (iter>end)  {
@@ -55,10 +56,12 @@ pair<uint32_t*,ParsedADCEvent> ADCUnpacker::parse(uint32_t* begin,uint32_t* end)
   auto dataEnd = iter + nWords;
   if(dataEnd > end) {
     bad_flag = 1;
+    last_errors |= BAD_COUNT;
   } else {
     iter = unpackData(iter, dataEnd, event);
   }
   if (iter>end || bad_flag || !isEOE(*(iter))){
+    if (iter>end || !isEOE(*(iter))) last_errors |= BAD_EOE;
     cout<<"ADCUnpacker::parse() ";
     cout<<"Unable to unpack event"<<endl;
   }
@@ -68,6 +71,32 @@ pair<uint32_t*,ParsedADCEvent> ADCUnpacker::parse(uint32_t* begin,uint32_t* end)
 
 }
 
+//Only the word count and EOE checks of parse(), without unpacking any data; steps through
+//the buffer exactly as parse() would so a scan stays in sync with a real conversion.
+//begin must point at a module header (callers find it with isHeader())
+pair<uint32_t*, int> ADCUnpacker::validate(uint32_t* begin, uint32_t* end) {
+
+  int flags = 0;
+  auto iter = begin;
+  int nWords = (*iter&HDR_COUNT_MASK) >> HDR_COUNT_SHIFT;
+  iter++;
+
+  auto dataEnd = iter + nWords;
+  if(nWords<0 || dataEnd>end) {
+    flags |= BAD_COUNT;
+  } else {
+    iter = dataEnd;
+  }
+
+  if(iter>=end || !isEOE(*iter)) {
+    flags |= BAD_EOE;
+  }
+  iter++;
+
+  return make_pair(iter, flags);
+
+}
+
 bool ADCUnpacker::isHeader(uint32_t word) {
   return ((word&TYPE_MASK) == TYPE_HDR);
 }
@@ -0,0 +1,142 @@
+/*Calibrator.cpp
+ *Class to hold per-module, per-channel gain/offset calibration coefficients and apply them to
+ *the raw module arrays in a single pass. See Calibrator.h for the coefficient file format.
+ */
+
+#include "Calibrator.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+using namespace std;
+
+Calibrator::Calibrator() {
+  //no table active until a run is set; apply() then passes values through uncalibrated
+  active = NULL;
+  warned = false;
+  unit_gain.resize(NCHANNELS, 1.0);
+  zero_offset.resize(NCHANNELS, 0.0);
+  resolve();
+}
+
+//read in all of the run range tables from a coefficient file
+bool Calibrator::readFile(string filename) {
+  ifstream input(filename);
+  if(!input.is_open()) {
+    cout<<"Error in Calibrator!!! File "<<filename<<" either cannot be opened or doesn't exist!"<<endl;
+    return false;
+  }
+  
+  tables.clear();
+  active = NULL;
+  resolve();
+  string line;
+  int lineNumber = 0;
+  while(getline(input, line)) {
+    lineNumber++;
+    if(line.empty() || line[0] == '#') continue;
+    istringstream words(line);
+    string first;
+    if(!(words>>first)) continue;
+    if(first == "run") {
+      CalibrationTable table;
+      if(!(words>>table.firstRun>>table.lastRun)) {
+        cout<<"Error in Calibrator!!! Bad run range at line "<<lineNumber<<" of "<<filename<<endl;
+        return false;
+      }
+      tables.push_back(table);
+      continue;
+    }
+    if(tables.empty()) {
+      cout<<"Error in Calibrator!!! Coefficients given before any run range at line "<<lineNumber<<" of "<<filename<<endl;
+      return false;
+    }
+    ModuleType type;
+    if(first == "madc") type = MADC_MODULE;
+    else if(first == "caen") type = CAEN_MODULE;
+    else {
+      cout<<"Error in Calibrator!!! Unknown module type "<<first<<" (expected madc or caen) at line "<<lineNumber<<" of "<<filename<<endl;
+      return false;
+    }
+    int module, channel;
+    Float_t gain, offset;
+    if(!(words>>module>>channel>>gain>>offset) || module<0 || channel<0 || channel>=(int)NCHANNELS) {
+      cout<<"Error in Calibrator!!! Bad coefficient entry at line "<<lineNumber<<" of "<<filename<<endl;
+      return false;
+    }
+    CalibrationTable& table = tables.back();
+    ModuleKey key = make_pair((int)type, module);
+    //first time a module is seen in a table, fill it with the identity so unlisted channels pass through
+    if(table.gains.find(key) == table.gains.end()) {
+      table.gains[key] = unit_gain;
+      table.offsets[key] = zero_offset;
+    }
+    table.gains[key][channel] = gain;
+    table.offsets[key][channel] = offset;
+  }
+  cout<<"Read "<<tables.size()<<" calibration table(s) from "<<filename<<endl;
+  return true;
+}
+
+//select the table for a run; called at each begin run so coefficients follow the run range
+void Calibrator::setRun(int runNumber) {
+  active = NULL;
+  warned = true;
+  for(auto& table:tables) {
+    if(runNumber >= table.firstRun && runNumber <= table.lastRun) {
+      active = &table;
+      break;
+    }
+  }
+  resolve();
+  if(active == NULL && !tables.empty()) {
+    cout<<"Warning in Calibrator!! No calibration table covers run "<<runNumber<<"; values will be uncalibrated"<<endl;
+  }
+}
+
+//drop the table at the start of each source so a file without a begin run item can't inherit the last one's
+void Calibrator::clearRun() {
+  active = NULL;
+  warned = false;
+  resolve();
+}
+
+//point every module at its coefficients in the active table, or at the identity if it has none
+void Calibrator::resolve() {
+  for(int type=0; type<2; type++) {
+    gain_ptr[type].clear();
+    offset_ptr[type].clear();
+  }
+  if(active == NULL) return;
+  for(auto& entry:active->gains) {
+    int type = entry.first.first, module = entry.first.second;
+    if(module >= (int)gain_ptr[type].size()) {
+      gain_ptr[type].resize(module+1, unit_gain.data());
+      offset_ptr[type].resize(module+1, zero_offset.data());
+    }
+    gain_ptr[type][module] = entry.second.data();
+    offset_ptr[type][module] = active->offsets.at(entry.first).data();
+  }
+}
+
+//calibrate a whole module; unset channels keep the reset value so they can still be cut on
+void Calibrator::apply(ModuleType type, int module, const vector<Int_t>& raw, vector<Float_t>& cal, Int_t reset_value) {
+  const Float_t *gain = unit_gain.data();
+  const Float_t *offset = zero_offset.data();
+  if(module >= 0 && module < (int)gain_ptr[type].size()) {
+    gain = gain_ptr[type][module];
+    offset = offset_ptr[type][module];
+  } else if(active == NULL && !warned && !tables.empty()) {
+    cout<<"Warning in Calibrator!! No begin run item seen, so no calibration table picked; values will be uncalibrated"<<endl;
+    warned = true;
+  }
+  
+  unsigned int n = raw.size() < cal.size() ? raw.size() : cal.size();
+  if(n > NCHANNELS) n = NCHANNELS;
+  const Int_t *in = raw.data();
+  Float_t *out = cal.data();
+  for(unsigned int i=0; i<n; i++) {
+    Float_t value = gain[i]*in[i] + offset[i];
+    out[i] = (in[i] == reset_value) ? (Float_t)reset_value : value;
+  }
+}
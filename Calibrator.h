@@ -0,0 +1,63 @@
+/*Calibrator.h
+ *Class to hold per-module, per-channel gain/offset calibration coefficients and apply them to
+ *the raw module arrays in a single pass. Coefficients are stored as structure-of-arrays (one gain 
+ *array and one offset array per module) so that the apply loop is a straight multiply-add over
+ *the 32 channels of a module.
+ *
+ *Coefficient files may hold several tables, each valid for a range of runs, so that one file can
+ *cover a whole campaign. Format (lines starting with # are comments):
+ *
+ *run <first run> <last run>
+ *madc <module id> <channel> <gain> <offset>
+ *caen <geo address> <channel> <gain> <offset>
+ *...
+ *
+ *Mesytec modules are named by their module id and CAEN modules by their geo address; the two number
+ *spaces overlap, so each line says which kind of module it is for.
+ *
+ *Channels that are not listed are left uncalibrated (gain 1, offset 0).
+ */
+
+#ifndef CALIBRATOR_H
+#define CALIBRATOR_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <TROOT.h>
+
+using namespace std;
+
+enum ModuleType { MADC_MODULE, CAEN_MODULE };
+typedef pair<int, int> ModuleKey; //module type, id (mADC) or geo (CAEN)
+
+struct CalibrationTable {
+  int firstRun, lastRun;
+  map<ModuleKey, vector<Float_t>> gains, offsets;
+};
+
+class Calibrator {
+  public:
+    Calibrator();
+    bool readFile(string filename);
+    void setRun(int runNumber);
+    void clearRun();
+    void apply(ModuleType type, int module, const vector<Int_t>& raw, vector<Float_t>& cal, Int_t reset_value);
+  
+  private:
+    void resolve();
+
+    vector<CalibrationTable> tables;
+    const CalibrationTable *active;
+    bool warned; //only complain once per source about running uncalibrated
+    vector<Float_t> unit_gain, zero_offset;
+    //coefficient arrays of the active table, indexed by module type then module number; resolved
+    //once per run so apply() does no lookups
+    vector<const Float_t*> gain_ptr[2], offset_ptr[2];
+
+    static const unsigned int NCHANNELS = 32;
+};
+
+#endif
@@ -8,9 +8,46 @@
 
 #include "ENCOREevt2root.h"
 #include <stdexcept>
+#include <chrono>
+#include <cstdio>
+#include <TBasket.h>
 
 using namespace std;
 
+//most physics items built into one event; a window wider than the real coincidences would otherwise swallow the run
+static const unsigned int MAX_COINCIDENCE = 64;
+
+//how many events between memory samples; walking the baskets every event would cost more than it's worth
+static const uint64_t MEMORY_CHECK_INTERVAL = 1000;
+
+//memory really held by the baskets of a list of branches (and their sub-branches): only baskets still in
+//memory are in a branch's basket list, each holding its allocated buffer
+static int64_t basketBytes(TObjArray *branches) {
+  int64_t bytes = 0;
+  for(int i=0; i<branches->GetEntries(); i++) {
+    TBranch *branch = (TBranch*)branches->At(i);
+    TObjArray *baskets = branch->GetListOfBaskets();
+    for(int j=0; j<baskets->GetEntries(); j++) {
+      TBasket *basket = (TBasket*)baskets->At(j);
+      if(basket != NULL) bytes += basket->GetBufferSize();
+    }
+    bytes += basketBytes(branch->GetListOfBranches());
+  }
+  return bytes;
+}
+
+static int64_t basketBytes(TTree *tree) {
+  return basketBytes(tree->GetListOfBranches());
+}
+
+//resolution of the modules, used to pick the compact storage of the parameters they feed
+static const int MADC_BITS = 12;
+static const int CAEN_BITS = 14;
+
+//madc2 channel feeding each edepl/edepr strip; mirrors the sorting in parseEvent
+static const int EDEPL_CHANNEL[16] = {1, 3, 5, 7, 9, 11, 13, 15, 14, 12, 10, 8, 6, 4, 2, 0};
+static const int EDEPR_CHANNEL[16] = {31, 29, 27, 25, 23, 21, 19, 17, 16, 18, 20, 22, 24, 26, 28, 30};
+
 //constructor
 evt2root::evt2root() {
   //sample and exclude not used in file conversion unless you really need speed
@@ -20,10 +57,32 @@ evt2root::evt2root() {
   madc1_values.resize(32);
   madc2_values.resize(32);
   tdc_values.resize(32);
+  madc1_compact.resize(32);
+  madc2_compact.resize(32);
+  madc1_cal.resize(32);
+  madc2_cal.resize(32);
+  tdc_cal.resize(32);
 
   //Source is set to NULL to avoid delete errors if there is unusual termination
   source = NULL;
+  merger = NULL;
+  coinc_window = 0;
+  merge = false;
   scalerTag = 0;
+  calibrate = false;
+  compact = false;
+  rollover = false;
+  max_bytes = 0;
+  max_entries = 0;
+  output = NULL;
+  ring_writer = NULL;
+  ring_slots = 0;
+  ring_force = false;
+  ring_events = 0;
+  runNumber = -1;
+  memory_checks = 0;
+  catalog_name = "run_catalog.dat";
+  catalog_record = RunRecord();
   madc1_id = 7;
   madc2_id = 9;
   tdc_geo = 16;
@@ -31,8 +90,55 @@ evt2root::evt2root() {
 }
 
 evt2root::~evt2root() {
+  if(finalizer.joinable()) finalizer.join();
   delete random;
   delete source;
+  delete merger;
+  delete ring_writer;
+}
+
+//read every file in the list at once and merge them by timestamp; a non-zero window
+//also builds events out of physics items that fall within window ticks of each other
+void evt2root::setMergeMode(uint64_t window) {
+  merge = true;
+  coinc_window = window;
+}
+
+//split the output over several files, starting a new one at either limit (0 means no limit)
+void evt2root::setRollover(Long64_t bytes, Long64_t entries) {
+  rollover = true;
+  if(bytes > 0) max_bytes = bytes;
+  if(entries > 0) max_entries = entries;
+}
+
+//also publish every event to a shared memory ring for local online analysis
+void evt2root::setSharedMemory(string name, uint32_t nSlots, bool force) {
+  //POSIX shared memory names have to start with a slash
+  if(name.empty() || name[0] != '/') name = "/" + name;
+  ring_name = name;
+  ring_slots = nSlots;
+  ring_force = force;
+}
+
+//cap the memory used for buffering (0 means no cap; use is still reported)
+void evt2root::setMemoryBudget(int64_t bytes) {
+  memory.setBudget(bytes);
+}
+
+//catalog that a record is appended to for every converted input; empty name turns it off
+void evt2root::setCatalogFile(string filename) {
+  catalog_name = filename;
+}
+
+//store the raw modules as 16 bit integers and the parameters as Float16_t
+void evt2root::setCompact() {
+  compact = true;
+}
+
+//turn on the calibration stage; coefficients are read at the start of run()
+void evt2root::setCalibrationFile(string filename) {
+  cal_name = filename;
+  calibrate = true;
 }
 
 //read in a list of evt files
@@ -56,6 +162,7 @@ bool evt2root::initDataSource(string evtname) {
     //source is dynamically allocated therefore must be deleted each time a new source is made
     if(source != NULL) delete source;
     source = CDataSourceFactory::makeSource(evtname, sample, exclude);
+    if(calibrate) calibrator.clearRun();
     return true;
   } catch(CException& error) {
     cout<<"Error in initDataSource!! Caught: "<<error.ReasonText()<<endl;
@@ -69,7 +176,7 @@ bool evt2root::initDataSource(string evtname) {
 bool evt2root::processSource() {
   try {
     //physics event counter for progress update
-    int physEvents = 0;
+    physEvents = 0;
     while(true) {
       CRingItem *ring = source->getItem();
       //so according to nscl documentation source->getItem() will always give a pointer, even if there are no more ring items. When it reaches the end of a file
@@ -88,46 +195,290 @@ bool evt2root::processSource() {
           break;
         }
       }
-      switch(ring->type()) {
-        case(PHYSICS_EVENT):
-          {
-            cout<<"\rNumber of Physics Events: "<<physEvents<<flush;
-            CPhysicsEventItem *phys_event = reinterpret_cast<CPhysicsEventItem*>(ring);
-            unpackPhysicsEvent(phys_event);
-            physEvents++;
-            break;
-          }
-        case(BEGIN_RUN):
-          {
-            CRingStateChangeItem *begin_event = reinterpret_cast<CRingStateChangeItem*>(ring);
-            unpackBegin(begin_event);
-            break;
-          }
-        case(END_RUN):
-          {
-            CRingStateChangeItem *end_event = reinterpret_cast<CRingStateChangeItem*>(ring);
-            cout<<endl;
-            unpackEnd(end_event);
-            break;
+      memory.update(MemoryMonitor::READER, ring->getItemPointer()->s_header.s_size);
+      countItem(ring);
+      processItem(ring);
+      delete ring;
+    }
+    return true;
+  } catch(CException& error) {
+    cout<<"Error in processSource!! Caught: "<<error.ReasonText()<<endl;
+    return false;
+  }
+}
+
+//hand a ring item off to the right unpacker
+void evt2root::processItem(CRingItem *ring) {
+  switch(ring->type()) {
+    case(PHYSICS_EVENT):
+      {
+        cout<<"\rNumber of Physics Events: "<<physEvents<<flush;
+        CPhysicsEventItem *phys_event = reinterpret_cast<CPhysicsEventItem*>(ring);
+        unpackPhysicsEvent(phys_event);
+        physEvents++;
+        break;
+      }
+    case(BEGIN_RUN):
+      {
+        CRingStateChangeItem *begin_event = reinterpret_cast<CRingStateChangeItem*>(ring);
+        unpackBegin(begin_event);
+        break;
+      }
+    case(END_RUN):
+      {
+        CRingStateChangeItem *end_event = reinterpret_cast<CRingStateChangeItem*>(ring);
+        cout<<endl;
+        unpackEnd(end_event);
+        break;
+      }
+    case(PERIODIC_SCALERS):
+      {
+        CRingScalerItem *scaler_event = reinterpret_cast<CRingScalerItem*>(ring);
+        unpackScalers(scaler_event);
+        break;
+      }
+  }
+}
+
+//walk every ring item of the source checking only module framing; no unpacking, no tree
+bool evt2root::validateSource(string evtname) {
+  ValidationStats stats = {};
+  stats.runNumber = -1;
+  auto start = chrono::steady_clock::now();
+  try {
+    while(true) {
+      CRingItem *ring = source->getItem();
+      if(ring == NULL) break;
+      uint64_t offset = stats.bytes;
+      stats.items++;
+      stats.bytes += ring->getItemPointer()->s_header.s_size;
+      if(ring->type() == PHYSICS_EVENT) {
+        if(validateEvent(reinterpret_cast<CPhysicsEventItem*>(ring), stats) != 0) {
+          stats.badEvents++;
+          stats.badOffsets.push_back(offset);
+        }
+        stats.physics++;
+        //keep the console quiet; printing every event costs more than the scan
+        if(stats.physics%100000 == 0) cout<<"\rNumber of Physics Events: "<<stats.physics<<flush;
+      } else if(ring->type() == BEGIN_RUN) {
+        stats.runNumber = reinterpret_cast<CRingStateChangeItem*>(ring)->getRunNumber();
+      }
+      delete ring;
+    }
+  } catch(CException& error) {
+    cout<<endl<<"Error in validateSource!! Caught: "<<error.ReasonText()<<endl;
+    printValidation(evtname, stats, chrono::duration<double>(chrono::steady_clock::now()-start).count());
+    return false;
+  }
+  printValidation(evtname, stats, chrono::duration<double>(chrono::steady_clock::now()-start).count());
+  return true;
+}
+
+//same module search as parseEvent, but only runs the unpackers' framing checks; returns nonzero if any failed
+int evt2root::validateEvent(CPhysicsEventItem* phys_event, ValidationStats& stats) {
+  uint16_t *bodyPointer = (uint16_t*)phys_event->getBodyPointer();
+  unsigned int size = (*bodyPointer++)/2;
+  uint32_t *iterPointer = (uint32_t*)bodyPointer;
+  uint32_t *endPointer = iterPointer+size;
+  int errors = 0;
+  while(iterPointer<endPointer) {
+    if(adc_unpacker.isHeader(*iterPointer)) {
+      auto adc = adc_unpacker.validate(iterPointer, endPointer);
+      if(adc.second&ADCUnpacker::BAD_COUNT) stats.adcErrors[0]++;
+      if(adc.second&ADCUnpacker::BAD_EOE) stats.adcErrors[1]++;
+      errors |= adc.second;
+      iterPointer = adc.first;
+    } else if(madc_unpacker.isHeader(*iterPointer)) {
+      auto madc = madc_unpacker.validate(iterPointer, endPointer);
+      if(madc.second&mADCUnpacker::BAD_COUNT) stats.madcErrors[0]++;
+      if(madc.second&mADCUnpacker::BAD_EOE) stats.madcErrors[1]++;
+      errors |= madc.second;
+      iterPointer = madc.first;
+    } else {
+      iterPointer++;
+    }
+  }
+  return errors;
+}
+
+//per-run integrity report for a validate-only scan
+void evt2root::printValidation(string evtname, ValidationStats& stats, double seconds) {
+  const unsigned int maxOffsets = 100;
+  cout<<"\r-----------------------"<<endl;
+  cout<<"Validated: "<<evtname<<endl;
+  if(stats.runNumber >= 0) cout<<"Run: "<<stats.runNumber<<endl;
+  else cout<<"Run: no begin run item found"<<endl;
+  cout<<"Ring items: "<<stats.items<<" Physics events: "<<stats.physics<<" Bytes: "<<stats.bytes<<endl;
+  if(seconds > 0) cout<<"Scan time: "<<seconds<<" s ("<<stats.bytes/seconds/1.0e6<<" MB/s)"<<endl;
+  cout<<"ADC errors (count/EOE): "<<stats.adcErrors[0]<<"/"<<stats.adcErrors[1]<<endl;
+  cout<<"mADC errors (count/EOE): "<<stats.madcErrors[0]<<"/"<<stats.madcErrors[1]<<endl;
+  cout<<"Bad events: "<<stats.badEvents<<endl;
+  for(unsigned int i=0; i<stats.badOffsets.size() && i<maxOffsets; i++) {
+    cout<<"  bad event at byte offset "<<stats.badOffsets[i]<<endl;
+  }
+  if(stats.badOffsets.size() > maxOffsets) {
+    cout<<"  ... and "<<stats.badOffsets.size()-maxOffsets<<" more"<<endl;
+  }
+  cout<<"-----------------------"<<endl;
+}
+
+//merge all of the sources in the list by timestamp and convert them as one stream
+bool evt2root::processMerged() {
+  try {
+    physEvents = 0;
+    vector<CPhysicsEventItem*> coincidence;
+    uint64_t coincStart = 0;
+    uint64_t coincBytes = 0;
+    uint64_t coincOverflows = 0;
+    uint64_t coincRepeats = 0;
+    vector<bool> coincSources(merger->getNSources(), false); //sources already in the open window
+    if(memory.getBudget() > 0 && (int64_t)merger->getBufferedBytes() > memory.getShare(MemoryMonitor::READER)) {
+      cout<<"Warning in ENCOREevt2root!! One item per source already fills the reader's memory share; it can't be cut any further"<<endl;
+    }
+    while(true) {
+      CRingItem *ring = merger->getItem();
+      memory.update(MemoryMonitor::READER, merger->getBufferedBytes() + coincBytes + (ring != NULL ? ring->getItemPointer()->s_header.s_size : 0));
+      if(ring != NULL) countItem(ring);
+      if(ring != NULL && ring->type() == PHYSICS_EVENT && coinc_window > 0) {
+        //build events: everything within the window of the first item goes into one entry
+        uint64_t stamp = merger->getLastTimestamp();
+        unsigned int index = merger->getLastSource();
+        bool close = false;
+        if(coincidence.size() >= MAX_COINCIDENCE ||
+           (memory.getBudget() > 0 && (int64_t)coincBytes >= memory.getShare(MemoryMonitor::READER))) {
+          if(coincOverflows++ == 0) {
+            cout<<endl<<"Warning in ENCOREevt2root!! More than "<<MAX_COINCIDENCE<<" items (or the reader's memory share) in one coincidence window; splitting events, check the window"<<endl;
           }
-        case(PERIODIC_SCALERS):
-          {
-            CRingScalerItem *scaler_event = reinterpret_cast<CRingScalerItem*>(ring);
-            unpackScalers(scaler_event);
-            break;
+          close = true;
+        } else if(!coincidence.empty() && stamp - coincStart > coinc_window) {
+          close = true;
+        } else if(coincSources[index]) {
+          //a second item from one source would overwrite the first one's branches, so it starts a new event
+          if(coincRepeats++ == 0) {
+            cout<<endl<<"Warning in ENCOREevt2root!! Two items from one source in one coincidence window; splitting events, check the window"<<endl;
           }
+          close = true;
+        }
+        if(close) {
+          flushCoincidence(coincidence);
+          coincBytes = 0;
+          coincSources.assign(coincSources.size(), false);
+        }
+        if(coincidence.empty()) coincStart = stamp;
+        coincSources[index] = true;
+        coincidence.push_back(reinterpret_cast<CPhysicsEventItem*>(ring));
+        coincBytes += ring->getItemPointer()->s_header.s_size;
+        continue;
       }
+      //anything else closes the open event first so item order is kept
+      flushCoincidence(coincidence);
+      coincBytes = 0;
+      coincSources.assign(coincSources.size(), false);
+      if(ring == NULL) {
+        cout<<endl;
+        if(merger->getErrno() == 0) {
+          cout<<"Merge of "<<merger->getNSources()<<" sources successful without warnings"<<endl;
+        } else {
+          cout<<"Merge of "<<merger->getNSources()<<" sources successful with warnings from errno: "<<merger->getErrno()<<endl;
+          cout<<"Continuing to run, check rootfile for buggy behavior after"<<endl; 
+        }
+        if(merger->getUnstamped() > 0) {
+          cout<<"Skipped "<<merger->getUnstamped()<<" physics items with no body header"<<endl;
+        }
+        if(coincOverflows > 0) {
+          cout<<"Split "<<coincOverflows<<" coincidence windows that were too big to hold"<<endl;
+        }
+        if(coincRepeats > 0) {
+          cout<<"Split "<<coincRepeats<<" coincidence windows holding two items from one source"<<endl;
+        }
+        cout<<"-----------------------"<<endl;
+        break;
+      }
+      processItem(ring);
       delete ring;
     }
     return true;
   } catch(CException& error) {
-    cout<<"Error in processSource!! Caught: "<<error.ReasonText()<<endl;
+    cout<<"Error in processMerged!! Caught: "<<error.ReasonText()<<endl;
     return false;
   }
 }
 
-//unpack physics event data; meat and potatoes of file conversion
+//unpack all of the physics items in a coincidence window into a single tree entry
+void evt2root::flushCoincidence(vector<CPhysicsEventItem*>& coincidence) {
+  if(coincidence.empty()) return;
+  cout<<"\rNumber of Physics Events: "<<physEvents<<flush;
+  reset();
+  for(auto phys_event:coincidence) {
+    parseEvent(phys_event);
+    delete phys_event;
+  }
+  coincidence.clear();
+  fillEvent();
+  physEvents++;
+}
+
+//unpack a single physics event into the tree
 void evt2root::unpackPhysicsEvent(CPhysicsEventItem* phys_event) {
+  //reset branch values to avoid overfill on empty fields
+  reset();
+  parseEvent(phys_event);
+  fillEvent();
+}
+
+//finish an event once all of its data is sorted, and write it out
+void evt2root::fillEvent() {
+  rebin(madc1_values); rebin(madc2_values); rebin(tdc_values);
+  getParameters();
+  if(compact) {
+    //12 bit values and the reset value all fit in 16 bits
+    for(int i=0; i<32; i++) {
+      madc1_compact[i] = madc1_values[i];
+      madc2_compact[i] = madc2_values[i];
+    }
+  }
+  //only start a new file once there is an event to put in it, so a run never ends on an empty one
+  checkRollover();
+  DataTree->Fill();
+  catalog_record.entries++;
+  if(ring_writer != NULL) publishEvent();
+  if(++memory_checks%MEMORY_CHECK_INTERVAL == 0) checkMemory();
+}
+
+//copy the finished event into the fixed record layout and hand it to the ring
+void evt2root::publishEvent() {
+  ring_record.eventNumber = ring_events++;
+  ring_record.runNumber = runNumber;
+  ring_record.scalerTag = scalerTag;
+  for(int i=0; i<32; i++) {
+    ring_record.madc1[i] = madc1_values[i];
+    ring_record.madc2[i] = madc2_values[i];
+    ring_record.tdc[i] = tdc_values[i];
+  }
+  for(int i=0; i<16; i++) {
+    ring_record.edepl[i] = edepl[i];
+    ring_record.edepr[i] = edepr[i];
+    ring_record.edepl_cal[i] = edepl_cal[i];
+    ring_record.edepr_cal[i] = edepr_cal[i];
+  }
+  ring_record.strip0 = strip0;
+  ring_record.strip17 = strip17;
+  ring_record.cath = cath;
+  ring_record.grid = grid;
+  ring_record.rf = rf;
+  ring_record.mcp = mcp;
+  ring_record.frisch = frisch;
+  ring_record.strip0_cal = strip0_cal;
+  ring_record.strip17_cal = strip17_cal;
+  ring_record.cath_cal = cath_cal;
+  ring_record.grid_cal = grid_cal;
+  ring_record.rf_cal = rf_cal;
+  ring_record.mcp_cal = mcp_cal;
+  ring_writer->publish(ring_record);
+}
+
+//parse physics event data into the branches; meat and potatoes of file conversion
+void evt2root::parseEvent(CPhysicsEventItem* phys_event) {
   //first 16 bit word is the length of the event
   uint16_t *bodyPointer = (uint16_t*)phys_event->getBodyPointer();
   unsigned int size = (*bodyPointer++)/2;
@@ -137,18 +488,18 @@ void evt2root::unpackPhysicsEvent(CPhysicsEventItem* phys_event) {
   uint32_t *endPointer = iterPointer+size;
   vector<ParsedmADCEvent> madc_data;
   vector<ParsedADCEvent> adc_data;
-  //reset branch values to avoid overfill on empty fields
-  reset();
   
   //loop over length of event; looks to see if the current word matches the format of one of the modules, slower (slightly) than giving stack order but
   //this method requires NO knowledge of stack to unpack, so if you move modules around there is no impact on the unpacking process
   while(iterPointer<endPointer) {
     if(adc_unpacker.isHeader(*iterPointer)) {
       auto adc = adc_unpacker.parse(iterPointer, endPointer);
+      if(adc_unpacker.getErrors() != 0) catalog_record.adcErrors++;
       adc_data.push_back(adc.second);
       iterPointer = adc.first;
     } else if(madc_unpacker.isHeader(*iterPointer)) {
       auto madc = madc_unpacker.parse(iterPointer, endPointer);
+      if(madc_unpacker.getErrors() != 0) catalog_record.madcErrors++;
       madc_data.push_back(madc.second);
       iterPointer = madc.first;
     } else {
@@ -210,10 +561,6 @@ void evt2root::unpackPhysicsEvent(CPhysicsEventItem* phys_event) {
       }
       }
   }
-   
-  rebin(madc1_values); rebin(madc2_values); rebin(tdc_values);
-  getParameters();
-  DataTree->Fill();
   return;
 }
 
@@ -230,12 +577,19 @@ void evt2root::unpackBegin(CRingStateChangeItem* begin_event) {
   cout<<"-----------------------"<<endl;
   cout<<"Converting Run: "<<begin_event->getRunNumber()<<endl;
   cout<<"Title: "<<begin_event->getTitle()<<endl;
+  runNumber = begin_event->getRunNumber();
+  catalog_record.runNumber = runNumber;
+  catalog_record.beginTime = begin_event->getTimestamp();
+  RunCatalog::setString(catalog_record.title, sizeof(catalog_record.title), begin_event->getTitle());
+  if(calibrate) calibrator.setRun(runNumber);
   return;
 }
 
 //unpack end event for consistency check
 void evt2root::unpackEnd(CRingStateChangeItem* end_event) {
   cout<<"End Run: "<<end_event->getRunNumber()<<endl;
+  catalog_record.endTime = end_event->getTimestamp();
+  catalog_record.elapsedTime = end_event->getElapsedTime();
   return;
 }
 
@@ -258,6 +612,17 @@ void evt2root::reset() {
  cath = RESET_VALUE;
  rf = RESET_VALUE;
  mcp = RESET_VALUE;
+
+  for(int i=0; i<16; i++) {
+    edepl_cal[i] = RESET_VALUE;
+    edepr_cal[i] = RESET_VALUE;
+  }
+  strip0_cal = RESET_VALUE;
+  strip17_cal = RESET_VALUE;
+  grid_cal = RESET_VALUE;
+  cath_cal = RESET_VALUE;
+  rf_cal = RESET_VALUE;
+  mcp_cal = RESET_VALUE;
   //RESET YOUR PARAMETERS HERE
   return;
 }
@@ -273,49 +638,269 @@ void evt2root::rebin(vector<Int_t> &module) {
 
 void evt2root::getParameters() {
 //add your parameters here; also be sure to add them to the reset list!!
-
+  if(calibrate) {
+    //one pass per module over the whole channel array, then pick the named parameters out of it
+    calibrator.apply(MADC_MODULE, madc1_id, madc1_values, madc1_cal, RESET_VALUE);
+    calibrator.apply(MADC_MODULE, madc2_id, madc2_values, madc2_cal, RESET_VALUE);
+    calibrator.apply(CAEN_MODULE, tdc_geo, tdc_values, tdc_cal, RESET_VALUE);
+    for(int i=0; i<16; i++) {
+      edepl_cal[i] = madc2_cal[EDEPL_CHANNEL[i]];
+      edepr_cal[i] = madc2_cal[EDEPR_CHANNEL[i]];
+    }
+    strip0_cal = madc1_cal[0];
+    cath_cal = madc1_cal[1];
+    grid_cal = madc1_cal[2];
+    strip17_cal = madc1_cal[3];
+    rf_cal = tdc_cal[0];
+    mcp_cal = tdc_cal[1];
+  }
 }
 
-//loop over evt files
-void evt2root::run(char *outname) {
-  string file;
-  bool errorFlag = true;
-  cout<<"----ENCORE evt2root conversion----"<<endl;
-  cout<<"Enter name of evt list file: ";
-  cin>>file;
-  cout<<"Beginning file conversion to "<<outname<<endl;
+//leaf list for a float parameter. Normally a full Float_t; in compact mode a Float16_t sized from the
+//resolution of the module it comes from. Raw values are integers from -10 (reset) up to 2^bits-1, so a range
+//of [-16, 2^(bits+1)-16) in bits+1 bits stores every one of them exactly (steps of 1). Calibrated values keep
+//a mantissa as wide as the ADC, which is all the precision the measurement has.
+string evt2root::leafList(string name, int bits, bool calibrated) {
+  if(!compact) return name + "/F";
+  if(calibrated) return name + "/f[0,0," + to_string(bits) + "]";
+  return name + "/f[-16," + to_string((1<<(bits+1))-16) + "," + to_string(bits+1) + "]";
+}
 
-  output = new TFile(outname, "RECREATE");
+//make a new output file with its trees; in rollover mode the name is built from the stem and file index
+void evt2root::openOutput(string name) {
+  if(rollover) {
+    char index[16];
+    snprintf(index, sizeof(index), "_%03d.root", (int)out_files.size());
+    name = out_stem + index;
+    cout<<endl<<"Writing to "<<name<<endl;
+  }
+  out_files.push_back(name);
+  output = new TFile(name.c_str(), "RECREATE");
   DataTree = new TTree("DataTree","DataTree");
   ScalerTree = new TTree("ScalerTree","ScalerTree");
 
-  DataTree->Branch("madc1",&madc1_values);
-  DataTree->Branch("madc2",&madc2_values);
+  if(compact) {
+    DataTree->Branch("madc1",&madc1_compact);
+    DataTree->Branch("madc2",&madc2_compact);
+  } else {
+    DataTree->Branch("madc1",&madc1_values);
+    DataTree->Branch("madc2",&madc2_values);
+  }
   DataTree->Branch("scalerTag", &scalerTag, "scalerTag/I");
-  DataTree->Branch("edepl",&edepl,"edepl[16]/F");
-  DataTree->Branch("edepr",&edepr,"edepr[16]/F");
-  DataTree->Branch("strip0",&strip0);
-  DataTree->Branch("grid",&grid);
-  DataTree->Branch("cath",&cath);
+  DataTree->Branch("edepl",&edepl,leafList("edepl[16]", MADC_BITS, false).c_str());
+  DataTree->Branch("edepr",&edepr,leafList("edepr[16]", MADC_BITS, false).c_str());
+  DataTree->Branch("strip0",&strip0,leafList("strip0", MADC_BITS, false).c_str());
+  DataTree->Branch("grid",&grid,leafList("grid", MADC_BITS, false).c_str());
+  DataTree->Branch("cath",&cath,leafList("cath", MADC_BITS, false).c_str());
   DataTree->Branch("seg",&seg,"seg[16]/I");
-  DataTree->Branch("strip17", &strip17);
-  DataTree->Branch("rf", &rf);
-  DataTree->Branch("mcp", &mcp);
-  DataTree->Branch("frisch", &frisch);
+  DataTree->Branch("strip17",&strip17,leafList("strip17", MADC_BITS, false).c_str());
+  DataTree->Branch("rf",&rf,leafList("rf", CAEN_BITS, false).c_str());
+  DataTree->Branch("mcp",&mcp,leafList("mcp", CAEN_BITS, false).c_str());
+  DataTree->Branch("frisch",&frisch,leafList("frisch", MADC_BITS, false).c_str());
+  if(calibrate) {
+    DataTree->Branch("edepl_cal",&edepl_cal,leafList("edepl_cal[16]", MADC_BITS, true).c_str());
+    DataTree->Branch("edepr_cal",&edepr_cal,leafList("edepr_cal[16]", MADC_BITS, true).c_str());
+    DataTree->Branch("strip0_cal",&strip0_cal,leafList("strip0_cal", MADC_BITS, true).c_str());
+    DataTree->Branch("grid_cal",&grid_cal,leafList("grid_cal", MADC_BITS, true).c_str());
+    DataTree->Branch("cath_cal",&cath_cal,leafList("cath_cal", MADC_BITS, true).c_str());
+    DataTree->Branch("strip17_cal",&strip17_cal,leafList("strip17_cal", MADC_BITS, true).c_str());
+    DataTree->Branch("rf_cal",&rf_cal,leafList("rf_cal", CAEN_BITS, true).c_str());
+    DataTree->Branch("mcp_cal",&mcp_cal,leafList("mcp_cal", CAEN_BITS, true).c_str());
+  }
   //add data branches here; not recommended to remove the raw module branches, as they are 
   //the easiest way to do debugging
 
   ScalerTree->Branch("scalers",&scalers);
+  ScalerTree->Branch("scalerTag",&scalerTag,"scalerTag/I");
   //add scaler branches here; again not recommended to remove the raw branch
 
+  if(memory.getBudget() > 0) {
+    //negative AutoFlush is in bytes; scalers are tiny so nearly all of the tree share goes to the data
+    Long64_t treeShare = memory.getShare(MemoryMonitor::TREES);
+    DataTree->SetAutoFlush(-treeShare*9/10);
+    ScalerTree->SetAutoFlush(-treeShare/10);
+  }
+}
+
+//write out and close the current file; in the background the previous finalization must finish first so only
+//one file is ever waiting to be closed
+void evt2root::closeOutput(bool background) {
+  if(finalizer.joinable()) finalizer.join();
+  memory.update(MemoryMonitor::FINALIZE, 0);
+  int64_t pending = basketBytes(DataTree) + basketBytes(ScalerTree);
+  if(background && memory.getBudget() > 0 && pending > memory.getShare(MemoryMonitor::FINALIZE)) {
+    //no room to keep the closing file's baskets around; close it here instead
+    memory.addStall();
+    background = false;
+  }
+  if(background) {
+    //the closing file's baskets stay in memory until the finalizer is done with them
+    memory.update(MemoryMonitor::FINALIZE, pending);
+    finalizer = thread(finalizeOutput, output);
+  } else {
+    finalizeOutput(output);
+  }
+  output = NULL;
+  DataTree = NULL;
+  ScalerTree = NULL;
+}
+
+//trees are owned by the file, so closing it cleans them up
+void evt2root::finalizeOutput(TFile *file) {
+  file->cd();
+  file->Write();
+  file->Close();
+  delete file;
+}
+
+//sample what the trees hold. Trees over their share get their baskets written out and resized to fit it;
+//over the whole budget, wait for the background finalizer to let go of the last file before taking more events
+void evt2root::checkMemory() {
+  memory.update(MemoryMonitor::TREES, basketBytes(DataTree) + basketBytes(ScalerTree));
+  if(memory.overShare(MemoryMonitor::TREES)) {
+    Long64_t treeShare = memory.getShare(MemoryMonitor::TREES);
+    DataTree->FlushBaskets();
+    DataTree->OptimizeBaskets(treeShare*9/10, 1.1, "");
+    ScalerTree->FlushBaskets();
+    ScalerTree->OptimizeBaskets(treeShare/10, 1.1, "");
+    memory.update(MemoryMonitor::TREES, basketBytes(DataTree) + basketBytes(ScalerTree));
+  }
+  if(memory.overBudget() && finalizer.joinable()) {
+    memory.addStall();
+    finalizer.join();
+    memory.update(MemoryMonitor::FINALIZE, 0);
+  }
+}
+
+//called before each fill: start a new file if the current one has hit the size or event limit
+void evt2root::checkRollover() {
+  if(!rollover) return;
+  if((max_entries > 0 && DataTree->GetEntries() >= max_entries) ||
+     (max_bytes > 0 && output->GetBytesWritten() >= max_bytes)) {
+    closeOutput(true);
+    openOutput("");
+    //the input's first event is going into the new file, not at the end of the old one
+    if(catalog_record.entries == 0) {
+      RunCatalog::setString(catalog_record.firstOutput, sizeof(catalog_record.firstOutput), out_files.back());
+      catalog_record.firstEntry = 0;
+    }
+  }
+}
+
+//list of every file made, one per line; load into a TChain with TFileCollection::AddFromFile
+void evt2root::writeManifest() {
+  string name = out_stem + "_files.lst";
+  ofstream manifest(name);
+  if(!manifest.is_open()) {
+    cout<<"Error in ENCOREevt2root!!! Could not write file list "<<name<<endl;
+    return;
+  }
+  for(auto& file:out_files) manifest<<file<<endl;
+  cout<<"Wrote "<<out_files.size()<<" file(s), listed in "<<name<<endl;
+}
+
+//start the catalog record for an input at the current position in the output
+void evt2root::beginRecord(string input) {
+  catalog_record = RunRecord();
+  catalog_record.runNumber = -1;
+  RunCatalog::setString(catalog_record.input, sizeof(catalog_record.input), input);
+  RunCatalog::setString(catalog_record.firstOutput, sizeof(catalog_record.firstOutput), out_files.back());
+  catalog_record.firstEntry = DataTree->GetEntries();
+}
+
+void evt2root::countItem(CRingItem *ring) {
+  catalog_record.totalItems++;
+  catalog_record.bytes += ring->getItemPointer()->s_header.s_size;
+  if(ring->type() == PHYSICS_EVENT) catalog_record.physicsItems++;
+  else if(ring->type() == PERIODIC_SCALERS) catalog_record.scalerItems++;
+}
+
+//close out the record where the input's entries end and append it to the catalog
+void evt2root::finishRecord() {
+  RunCatalog::setString(catalog_record.lastOutput, sizeof(catalog_record.lastOutput), out_files.back());
+  catalog_record.lastEntry = DataTree->GetEntries();
+  if(!catalog_name.empty()) RunCatalog::append(catalog_name, catalog_record);
+}
+
+//validate-only fast scan over the evt files; checks module framing and writes nothing
+void evt2root::validate() {
+  string file;
+  cout<<"----ENCORE evt2root validation----"<<endl;
+  cout<<"Enter name of evt list file: ";
+  cin>>file;
+  if(readFileList(file)) {
+    for(unsigned int i=0; i<evt_list.size(); i++) {
+      if(initDataSource(evt_list[i])) validateSource(evt_list[i]);
+    }
+  }
+}
+
+//loop over evt files
+void evt2root::run(char *outname) {
+  string file;
+  bool errorFlag = true;
+  cout<<"----ENCORE evt2root conversion----"<<endl;
+  cout<<"Enter name of evt list file: ";
+  cin>>file;
+  if(calibrate && !calibrator.readFile(cal_name)) return;
+  if(!ring_name.empty()) {
+    int64_t ringShare = memory.getShare(MemoryMonitor::RING);
+    if(memory.getBudget() > 0 && (int64_t)EventRingWriter::getSizeFor(ring_slots) > ringShare) {
+      //shrink the ring to fit its share of the budget
+      int64_t slots = (ringShare - (int64_t)EventRingWriter::getSizeFor(0))/(int64_t)sizeof(EventRingSlot);
+      if(slots < 1) {
+        cout<<"Error in ENCOREevt2root!!! Memory budget is too small to hold a shared memory ring"<<endl;
+        return;
+      }
+      cout<<"Shared memory ring cut to "<<slots<<" slots to fit the memory budget"<<endl;
+      ring_slots = slots;
+    }
+    ring_writer = new EventRingWriter();
+    if(!ring_writer->open(ring_name, ring_slots, ring_force)) return;
+    ring_record = EventRecord();
+    memory.update(MemoryMonitor::RING, ring_writer->getSize());
+  }
+  cout<<"Beginning file conversion to "<<outname<<endl;
+
+  if(rollover) {
+    //finalization of full files happens on a separate thread while we keep converting
+    ROOT::EnableThreadSafety();
+    out_stem = outname;
+    if(out_stem.size() > 5 && out_stem.compare(out_stem.size()-5, 5, ".root") == 0) {
+      out_stem.erase(out_stem.size()-5);
+    }
+  }
+  openOutput(outname);
+
   errorFlag = readFileList(file);
-  if(errorFlag) {
+  if(errorFlag && merge) {
+    merger = new EventMerger();
     for(unsigned int i=0; i<evt_list.size(); i++) {
       errorFlag = initDataSource(evt_list[i]);
       if(errorFlag) {
+        //merger takes ownership of the source
+        merger->addSource(source, evt_list[i]);
+        source = NULL;
+      }
+    }
+    //merged sources make a single stream, so they get a single catalog record
+    beginRecord("merged:" + file);
+    processMerged();
+    finishRecord();
+  } else if(errorFlag) {
+    for(unsigned int i=0; i<evt_list.size(); i++) {
+      errorFlag = initDataSource(evt_list[i]);
+      if(errorFlag) {
+        beginRecord(evt_list[i]);
         errorFlag = processSource();
+        finishRecord();
         if(!errorFlag) break;
       }
     }
   }
+
+  closeOutput(false);
+  if(rollover) writeManifest();
+  if(ring_writer != NULL) ring_writer->close();
+  memory.report();
 }
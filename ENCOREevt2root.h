@@ -13,6 +13,7 @@
 #include <fstream>
 #include <string>
 #include <cerrno>
+#include <thread>
 
 #include "DataFormat.h"
 #include "CDataSourceFactory.h"
@@ -31,19 +32,43 @@
 
 #include "ADCUnpacker.h"
 #include "mADCUnpacker.h"
+#include "Calibrator.h"
+#include "EventMerger.h"
+#include "EventRing.h"
+#include "MemoryMonitor.h"
+#include "RunCatalog.h"
 
 using namespace std;
 
+//integrity counts for one source, filled by a validate-only scan
+struct ValidationStats {
+  int runNumber;
+  uint64_t items, physics, bytes, badEvents;
+  uint64_t adcErrors[2], madcErrors[2]; //count, EOE
+  vector<uint64_t> badOffsets; //byte offset of each bad physics item in the source
+};
+
 class evt2root {
   public:
     evt2root();
     ~evt2root();
     void run(char *outname);
+    void validate();
+    void setCalibrationFile(string filename);
+    void setMergeMode(uint64_t window);
+    void setRollover(Long64_t bytes, Long64_t entries);
+    void setSharedMemory(string name, uint32_t nSlots, bool force);
+    void setMemoryBudget(int64_t bytes);
+    void setCatalogFile(string filename);
+    string getCatalogFile() { return catalog_name; };
+    void setCompact();
   
   private:
     int madc1_id, madc2_id, tdc_geo;
     vector<Int_t> madc1_values, madc2_values, tdc_values;
     vector<UInt_t> scalers;
+    bool compact;
+    vector<Short_t> madc1_compact, madc2_compact;
     Float_t strip0;
     float         edepl[16];
     float         edepr[16];
@@ -55,25 +80,74 @@ class evt2root {
     Float_t	   mcp;
     Float_t	   frisch;
     Int_t scalerTag;
+    //calibrated copies of the modules and parameters, only filled if a calibration file is given
+    bool calibrate;
+    string cal_name;
+    vector<Float_t> madc1_cal, madc2_cal, tdc_cal;
+    float         edepl_cal[16];
+    float         edepr_cal[16];
+    Float_t strip0_cal, strip17_cal, cath_cal, grid_cal, rf_cal, mcp_cal;
     vector<string> evt_list;
     vector<uint16_t> sample, exclude;
     void reset();
     void rebin(vector<Int_t>& module);
     bool initDataSource(string evtname);
     bool processSource();
+    bool processMerged();
+    bool validateSource(string evtname);
+    int validateEvent(CPhysicsEventItem *phys_event, ValidationStats& stats);
+    void printValidation(string evtname, ValidationStats& stats, double seconds);
+    void processItem(CRingItem *ring);
+    void flushCoincidence(vector<CPhysicsEventItem*>& coincidence);
     bool readFileList(string filename);
     void unpackPhysicsEvent(CPhysicsEventItem *phys_event);
+    void parseEvent(CPhysicsEventItem *phys_event);
+    void fillEvent();
+    void publishEvent();
     void unpackEnd(CRingStateChangeItem *end_event);
     void unpackBegin(CRingStateChangeItem *begin_event);
     void unpackScalers(CRingScalerItem *scaler_event);
     void getParameters();
+    void openOutput(string name);
+    string leafList(string name, int bits, bool calibrated);
+    void closeOutput(bool background);
+    static void finalizeOutput(TFile *file);
+    void checkRollover();
+    void writeManifest();
+    void checkMemory();
+    void beginRecord(string input);
+    void countItem(CRingItem *ring);
+    void finishRecord();
     CDataSource *source;
+    EventMerger *merger;
+    bool merge;
+    uint64_t coinc_window;
+    int physEvents;
     ADCUnpacker adc_unpacker;
     mADCUnpacker madc_unpacker;
+    Calibrator calibrator;
     TRandom3 *random;
     TFile *output;
     TTree *DataTree;
     TTree *ScalerTree;
+    bool rollover;
+    Long64_t max_bytes, max_entries;
+    string out_stem;
+    vector<string> out_files;
+    thread finalizer;
+    //optional shared memory sink, runs alongside the tree
+    EventRingWriter *ring_writer;
+    string ring_name;
+    uint32_t ring_slots;
+    bool ring_force;
+    EventRecord ring_record;
+    uint64_t ring_events;
+    int runNumber;
+    MemoryMonitor memory;
+    uint64_t memory_checks;
+    //one catalog record per converted input
+    string catalog_name;
+    RunRecord catalog_record;
 
     Int_t RESET_VALUE = -10;
 };
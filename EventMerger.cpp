@@ -0,0 +1,84 @@
+/*EventMerger.cpp
+ *Class to read several nscldaq data sources at once and hand back their ring items in timestamp
+ *order. See EventMerger.h for details.
+ */
+
+#include "EventMerger.h"
+#include <iostream>
+#include <cerrno>
+
+using namespace std;
+
+EventMerger::EventMerger() {
+  last_time = 0;
+  last_source = 0;
+  buffered = 0;
+  total_unstamped = 0;
+  last_errno = 0;
+}
+
+//merger owns its sources
+EventMerger::~EventMerger() {
+  for(auto item:lookahead) delete item;
+  for(auto source:sources) delete source;
+}
+
+//take ownership of an opened source and prime its lookahead
+void EventMerger::addSource(CDataSource *source, string name) {
+  sources.push_back(source);
+  names.push_back(name);
+  lookahead.push_back(NULL);
+  last_stamp.push_back(0);
+  unstamped.push_back(0);
+  advance(sources.size()-1);
+}
+
+uint64_t EventMerger::getTimestamp(CRingItem *item, unsigned int index) {
+  if(item->hasBodyHeader()) {
+    last_stamp[index] = item->getEventTimestamp();
+  }
+  return last_stamp[index];
+}
+
+//pull the next item from a source into its lookahead slot; false once the source is exhausted
+bool EventMerger::advance(unsigned int index) {
+  errno = 0;
+  CRingItem *item = sources[index]->getItem();
+  //physics items can't be put in order without a timestamp, so they are dropped rather than all piling up at the last one
+  while(item != NULL && item->type() == PHYSICS_EVENT && !item->hasBodyHeader()) {
+    if(unstamped[index] == 0) {
+      cout<<"Warning in EventMerger!! Source "<<names[index]<<" has physics items with no body header; they can't be merged and will be skipped"<<endl;
+    }
+    unstamped[index]++;
+    total_unstamped++;
+    delete item;
+    errno = 0;
+    item = sources[index]->getItem();
+  }
+  lookahead[index] = item;
+  if(item == NULL) {
+    //same errno convention as a single source: NULL with errno set is a warning, not a failure
+    if(errno != 0) {
+      cout<<"Source "<<names[index]<<" ended with warnings from errno: "<<errno<<endl;
+      last_errno = errno;
+    }
+    return false;
+  }
+  buffered += item->getItemPointer()->s_header.s_size;
+  heap.push(make_pair(getTimestamp(item, index), index));
+  return true;
+}
+
+//next item in timestamp order across all sources; NULL when every source is exhausted.
+//Caller owns the returned item.
+CRingItem* EventMerger::getItem() {
+  if(heap.empty()) return NULL;
+  HeapEntry next = heap.top();
+  heap.pop();
+  CRingItem *item = lookahead[next.second];
+  last_time = next.first;
+  last_source = next.second;
+  buffered -= item->getItemPointer()->s_header.s_size;
+  advance(next.second);
+  return item;
+}
@@ -0,0 +1,60 @@
+/*EventMerger.h
+ *Class to read several nscldaq data sources at once and hand back their ring items in timestamp
+ *order. Each source is assumed to be time ordered on its own, so only one item per source needs to
+ *be held at any time (the lookahead); a min-heap on the body header timestamps of those items picks
+ *the next one to return. Memory use is therefore bounded by the number of sources, not their size.
+ *
+ *Non-physics items without a body header (e.g. state changes from an unbuilt stream) inherit the last
+ *timestamp seen on their source so they stay in place relative to that source's events. Physics items
+ *without a body header have no place in the merged order, so they are skipped and counted.
+ */
+
+#ifndef EVENTMERGER_H
+#define EVENTMERGER_H
+
+#include <vector>
+#include <queue>
+#include <string>
+#include <utility>
+#include <functional>
+#include <cstdint>
+
+#include "DataFormat.h"
+
+#include "CDataSource.h"
+#include "CRingItem.h"
+
+using namespace std;
+
+class EventMerger {
+  public:
+    EventMerger();
+    ~EventMerger();
+    void addSource(CDataSource *source, string name);
+    CRingItem* getItem();
+    unsigned int getNSources() { return sources.size(); };
+    uint64_t getLastTimestamp() { return last_time; };
+    unsigned int getLastSource() { return last_source; };
+    uint64_t getBufferedBytes() { return buffered; };
+    uint64_t getUnstamped() { return total_unstamped; };
+    int getErrno() { return last_errno; };
+
+  private:
+    typedef pair<uint64_t, unsigned int> HeapEntry; //timestamp, source index
+    bool advance(unsigned int index);
+    uint64_t getTimestamp(CRingItem *item, unsigned int index);
+
+    vector<CDataSource*> sources;
+    vector<string> names;
+    vector<CRingItem*> lookahead;
+    vector<uint64_t> last_stamp;
+    vector<uint64_t> unstamped; //physics items skipped for having no body header
+    uint64_t total_unstamped;
+    priority_queue<HeapEntry, vector<HeapEntry>, greater<HeapEntry>> heap;
+    uint64_t last_time;
+    unsigned int last_source; //source of the item getItem() last returned
+    uint64_t buffered; //bytes held in the lookahead
+    int last_errno;
+};
+
+#endif
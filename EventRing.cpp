@@ -0,0 +1,218 @@
+/*EventRing.cpp
+ *POSIX shared memory ring buffer for handing decoded events from evt2root to another process on
+ *the same host. See EventRing.h for the protocol and reader usage.
+ */
+
+#include "EventRing.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static size_t ringSize(uint32_t nSlots) {
+  return sizeof(EventRingHeader) + 64 + (size_t)nSlots*sizeof(EventRingSlot);
+}
+
+size_t EventRingWriter::getSizeFor(uint32_t nSlots) {
+  return ringSize(nSlots);
+}
+
+//slots start on their own cache line after the header
+static EventRingSlot* ringSlots(void *memory) {
+  return reinterpret_cast<EventRingSlot*>((char*)memory + ((sizeof(EventRingHeader)+63)/64)*64);
+}
+
+EventRingWriter::EventRingWriter() {
+  shm_dev = 0;
+  shm_ino = 0;
+  memory = NULL;
+  mem_size = 0;
+  header = NULL;
+  slots = NULL;
+}
+
+EventRingWriter::~EventRingWriter() {
+  close();
+}
+
+//create a fresh segment. An existing one with the same name may belong to a live converter, so it is only
+//removed when force is set (e.g. to clear a segment left behind by a crash).
+bool EventRingWriter::open(string name, uint32_t nSlots, bool force) {
+  if(nSlots == 0) {
+    cout<<"Error in EventRingWriter!!! Ring must have at least one slot"<<endl;
+    return false;
+  }
+  shm_name = name;
+  if(force) shm_unlink(shm_name.c_str());
+  //readable by everyone on the host, writable only by the converter's user
+  int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if(fd < 0) {
+    if(errno == EEXIST) {
+      cout<<"Error in EventRingWriter!!! Shared memory "<<shm_name<<" already exists; another converter may be using it."<<endl;
+      cout<<"Pick another name, or use --shm-force if it was left behind by a crash"<<endl;
+    } else {
+      cout<<"Error in EventRingWriter!!! Could not create shared memory "<<shm_name<<": "<<strerror(errno)<<endl;
+    }
+    shm_name.clear();
+    return false;
+  }
+  struct stat info;
+  if(fstat(fd, &info) == 0) {
+    shm_dev = info.st_dev;
+    shm_ino = info.st_ino;
+  }
+  mem_size = ringSize(nSlots);
+  if(ftruncate(fd, mem_size) != 0) {
+    cout<<"Error in EventRingWriter!!! Could not size shared memory "<<shm_name<<": "<<strerror(errno)<<endl;
+    ::close(fd);
+    shm_unlink(shm_name.c_str());
+    return false;
+  }
+  memory = mmap(NULL, mem_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(memory == MAP_FAILED) {
+    cout<<"Error in EventRingWriter!!! Could not map shared memory "<<shm_name<<": "<<strerror(errno)<<endl;
+    memory = NULL;
+    shm_unlink(shm_name.c_str());
+    return false;
+  }
+
+  header = new (memory) EventRingHeader;
+  slots = ringSlots(memory);
+  for(uint32_t i=0; i<nSlots; i++) {
+    new (&slots[i]) EventRingSlot;
+    slots[i].sequence.store(0, memory_order_relaxed);
+  }
+  header->version = EVENTRING_VERSION;
+  header->recordSize = sizeof(EventRecord);
+  header->nSlots = nSlots;
+  header->finished.store(0, memory_order_relaxed);
+  header->head.store(0, memory_order_relaxed);
+  //magic goes in last so a reader never attaches to a half made ring
+  atomic_thread_fence(memory_order_release);
+  header->magic = EVENTRING_MAGIC;
+  cout<<"Publishing events to shared memory "<<shm_name<<" ("<<nSlots<<" slots)"<<endl;
+  return true;
+}
+
+//never blocks; the oldest record is overwritten when the ring is full
+void EventRingWriter::publish(const EventRecord& record) {
+  uint64_t n = header->head.load(memory_order_relaxed);
+  EventRingSlot& slot = slots[n%header->nSlots];
+  slot.sequence.store(2*n+1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  memcpy(&slot.record, &record, sizeof(EventRecord));
+  slot.sequence.store(2*n+2, memory_order_release);
+  header->head.store(n+1, memory_order_release);
+}
+
+//readers already attached keep their mapping; the name is removed so nobody attaches to a dead ring
+void EventRingWriter::close() {
+  if(memory == NULL) return;
+  header->finished.store(1, memory_order_release);
+  munmap(memory, mem_size);
+  //only remove the name if it is still ours (it may have been taken over with force)
+  int fd = shm_open(shm_name.c_str(), O_RDONLY, 0);
+  if(fd >= 0) {
+    struct stat info;
+    if(fstat(fd, &info) == 0 && info.st_dev == shm_dev && info.st_ino == shm_ino) shm_unlink(shm_name.c_str());
+    ::close(fd);
+  }
+  memory = NULL;
+  header = NULL;
+  slots = NULL;
+}
+
+EventRingReader::EventRingReader() {
+  memory = NULL;
+  mem_size = 0;
+  header = NULL;
+  slots = NULL;
+  position = 0;
+  lost = 0;
+}
+
+EventRingReader::~EventRingReader() {
+  close();
+}
+
+//attach to a ring made by evt2root; by default start at the newest event, or at the oldest still held
+bool EventRingReader::open(string name, bool fromStart) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(fd < 0) {
+    cout<<"Error in EventRingReader!!! Could not open shared memory "<<name<<": "<<strerror(errno)<<endl;
+    return false;
+  }
+  struct stat info;
+  if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(EventRingHeader)) {
+    cout<<"Error in EventRingReader!!! Shared memory "<<name<<" is not an event ring"<<endl;
+    ::close(fd);
+    return false;
+  }
+  mem_size = info.st_size;
+  memory = mmap(NULL, mem_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(memory == MAP_FAILED) {
+    cout<<"Error in EventRingReader!!! Could not map shared memory "<<name<<": "<<strerror(errno)<<endl;
+    memory = NULL;
+    return false;
+  }
+  header = reinterpret_cast<EventRingHeader*>(memory);
+  atomic_thread_fence(memory_order_acquire);
+  if(header->magic != EVENTRING_MAGIC || header->version != EVENTRING_VERSION ||
+     header->recordSize != sizeof(EventRecord) || mem_size < ringSize(header->nSlots)) {
+    cout<<"Error in EventRingReader!!! Shared memory "<<name<<" has the wrong layout or version"<<endl;
+    close();
+    return false;
+  }
+  slots = ringSlots(memory);
+  uint64_t head = header->head.load(memory_order_acquire);
+  if(!fromStart) position = head;
+  else position = head > header->nSlots ? head - header->nSlots : 0;
+  lost = 0;
+  return true;
+}
+
+//copy out the next event if there is one; false if the reader has caught up with the writer
+bool EventRingReader::next(EventRecord& record) {
+  while(true) {
+    uint64_t head = header->head.load(memory_order_acquire);
+    if(position >= head) return false;
+    if(head - position > header->nSlots) {
+      lost += head - position - header->nSlots;
+      position = head - header->nSlots;
+    }
+    EventRingSlot& slot = slots[position%header->nSlots];
+    uint64_t before = slot.sequence.load(memory_order_acquire);
+    if(before == 2*position+2) {
+      memcpy(&record, &slot.record, sizeof(EventRecord));
+      atomic_thread_fence(memory_order_acquire);
+      uint64_t after = slot.sequence.load(memory_order_relaxed);
+      if(after == before) {
+        position++;
+        return true;
+      }
+    }
+    //writer lapped us on this slot; drop it and try the next one
+    lost++;
+    position++;
+  }
+}
+
+bool EventRingReader::isFinished() {
+  return header != NULL && header->finished.load(memory_order_acquire) != 0 &&
+    position >= header->head.load(memory_order_acquire);
+}
+
+void EventRingReader::close() {
+  if(memory != NULL) munmap(memory, mem_size);
+  memory = NULL;
+  header = NULL;
+  slots = NULL;
+}
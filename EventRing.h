@@ -0,0 +1,111 @@
+/*EventRing.h
+ *POSIX shared memory ring buffer for handing decoded events from evt2root to another process on
+ *the same host without going through a ROOT file. One writer (evt2root) publishes fixed layout
+ *EventRecords; any number of readers can follow along. Nothing is locked: each slot carries a
+ *sequence number that the writer bumps before and after copying a record in (a seqlock), so a reader
+ *can always tell if the slot it copied was overwritten underneath it. The writer never waits on
+ *readers; a reader that falls more than a ring's worth behind skips ahead and counts what it lost.
+ *
+ *This file and EventRing.cpp have no ROOT or nscldaq dependence, so they build on their own into
+ *libEventRing.so for use by analysis code. Reader usage:
+ *
+ *  EventRingReader reader;
+ *  if(reader.open("/encore_events")) {
+ *    EventRecord event;
+ *    while(true) {
+ *      if(reader.next(event)) { ...use event... }
+ *      else if(reader.isFinished()) break;
+ *      else usleep(100);
+ *    }
+ *  }
+ */
+
+#ifndef EVENTRING_H
+#define EVENTRING_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+using namespace std;
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "EventRing needs lock-free 64 bit atomics to work across processes");
+
+//One decoded event. Layout is fixed (no pointers, explicit sizes) since it is read by other processes;
+//bump EVENTRING_VERSION if it changes. Unset values hold the evt2root reset value (-10).
+struct EventRecord {
+  uint64_t eventNumber;
+  int32_t runNumber;
+  int32_t scalerTag;
+  int32_t madc1[32];
+  int32_t madc2[32];
+  int32_t tdc[32];
+  float edepl[16];
+  float edepr[16];
+  float strip0, strip17, cath, grid, rf, mcp, frisch;
+  float edepl_cal[16];
+  float edepr_cal[16];
+  float strip0_cal, strip17_cal, cath_cal, grid_cal, rf_cal, mcp_cal;
+  int32_t unused;
+};
+
+static_assert(sizeof(EventRecord) == 712, "EventRecord layout changed; bump EVENTRING_VERSION");
+
+static const uint32_t EVENTRING_MAGIC = 0x454e4352; //"ENCR"
+static const uint32_t EVENTRING_VERSION = 1;
+
+struct EventRingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t recordSize;
+  uint32_t nSlots;
+  atomic<uint32_t> finished; //set by the writer when it closes
+  atomic<uint64_t> head; //number of records published so far
+};
+
+struct EventRingSlot {
+  atomic<uint64_t> sequence; //2n+1 while record n is being written, 2n+2 once it is complete
+  EventRecord record;
+};
+
+class EventRingWriter {
+  public:
+    EventRingWriter();
+    ~EventRingWriter();
+    bool open(string name, uint32_t nSlots, bool force=false);
+    void publish(const EventRecord& record);
+    void close();
+    size_t getSize() { return mem_size; };
+    static size_t getSizeFor(uint32_t nSlots);
+
+  private:
+    string shm_name;
+    dev_t shm_dev; //identity of our segment, so close() never unlinks someone else's
+    ino_t shm_ino;
+    void *memory;
+    size_t mem_size;
+    EventRingHeader *header;
+    EventRingSlot *slots;
+};
+
+class EventRingReader {
+  public:
+    EventRingReader();
+    ~EventRingReader();
+    bool open(string name, bool fromStart=false);
+    bool next(EventRecord& record);
+    bool isFinished();
+    uint64_t getLost() { return lost; };
+    void close();
+
+  private:
+    void *memory;
+    size_t mem_size;
+    EventRingHeader *header;
+    EventRingSlot *slots;
+    uint64_t position, lost;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*MemoryMonitor.cpp
+ *Class to keep the conversion inside a memory budget. See MemoryMonitor.h for details.
+ */
+
+#include "MemoryMonitor.h"
+#include <iostream>
+#include <sys/resource.h>
+
+using namespace std;
+
+static const char* COMPONENT_NAMES[MemoryMonitor::NCOMPONENTS] = {"reader", "tree baskets", "finalize queue", "shm ring"};
+//fraction of the budget each component is allowed
+static const double COMPONENT_SHARES[MemoryMonitor::NCOMPONENTS] = {0.10, 0.50, 0.25, 0.15};
+
+MemoryMonitor::MemoryMonitor() {
+  budget = 0;
+  stalls = 0;
+  for(int i=0; i<NCOMPONENTS; i++) {
+    current[i] = 0;
+    highWater[i] = 0;
+  }
+}
+
+//0 means no budget; components are then only monitored
+void MemoryMonitor::setBudget(int64_t bytes) {
+  budget = bytes > 0 ? bytes : 0;
+}
+
+int64_t MemoryMonitor::getShare(Component component) {
+  return (int64_t)(budget*COMPONENT_SHARES[component]);
+}
+
+void MemoryMonitor::update(Component component, int64_t bytes) {
+  current[component] = bytes;
+  if(bytes > highWater[component]) highWater[component] = bytes;
+}
+
+//total held by all of the components against the budget
+bool MemoryMonitor::overBudget() {
+  int64_t total = 0;
+  for(int i=0; i<NCOMPONENTS; i++) total += current[i];
+  return budget > 0 && total > budget;
+}
+
+bool MemoryMonitor::overShare(Component component) {
+  return budget > 0 && current[component] > getShare(component);
+}
+
+//kernel's record of the peak resident set size, in bytes
+int64_t MemoryMonitor::peakRSS() {
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+  return (int64_t)usage.ru_maxrss*1024; //ru_maxrss is kB on linux
+}
+
+void MemoryMonitor::report() {
+  const double MB = 1.0e6;
+  cout<<"-----------------------"<<endl;
+  cout<<"Memory use:"<<endl;
+  cout<<"Peak RSS: "<<peakRSS()/MB<<" MB";
+  if(budget > 0) cout<<" (buffering budget "<<budget/MB<<" MB, "<<stalls<<" backpressure stalls)";
+  cout<<endl;
+  for(int i=0; i<NCOMPONENTS; i++) {
+    cout<<"  "<<COMPONENT_NAMES[i]<<" high-water: "<<highWater[i]/MB<<" MB";
+    if(budget > 0) cout<<" (share "<<getShare((Component)i)/MB<<" MB)";
+    cout<<endl;
+  }
+  cout<<"-----------------------"<<endl;
+}
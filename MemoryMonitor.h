@@ -0,0 +1,39 @@
+/*MemoryMonitor.h
+ *Class to keep the conversion's buffering inside a memory budget. The budget is split into fixed shares
+ *for each buffering component (reader lookahead, tree baskets, files waiting to be finalized, shared
+ *memory ring); the owner of each component reads its share to size itself and reports the bytes it
+ *really holds, which are kept as high-water marks. The budget covers buffering only, not the code and
+ *libraries, so overBudget() compares the sum of the components against it. Peak RSS (from the kernel)
+ *and the high-water marks are reported at the end.
+ */
+
+#ifndef MEMORYMONITOR_H
+#define MEMORYMONITOR_H
+
+#include <cstdint>
+
+using namespace std;
+
+class MemoryMonitor {
+  public:
+    enum Component { READER, TREES, FINALIZE, RING, NCOMPONENTS };
+
+    MemoryMonitor();
+    void setBudget(int64_t bytes);
+    int64_t getBudget() { return budget; };
+    int64_t getShare(Component component);
+    void update(Component component, int64_t bytes);
+    bool overBudget();
+    bool overShare(Component component);
+    void addStall() { stalls++; };
+    void report();
+    static int64_t peakRSS();
+
+  private:
+    int64_t budget;
+    int64_t current[NCOMPONENTS];
+    int64_t highWater[NCOMPONENTS];
+    uint64_t stalls;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*RunCatalog.cpp
+ *Append-only binary catalog of converted runs. See RunCatalog.h for details.
+ */
+
+#include "RunCatalog.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+
+//copy a string into a fixed size field, always null terminated
+void RunCatalog::setString(char *field, size_t size, string value) {
+  strncpy(field, value.c_str(), size-1);
+  field[size-1] = '\0';
+}
+
+bool RunCatalog::append(string filename, RunRecord& record) {
+  record.magic = RUNCATALOG_MAGIC;
+  record.version = RUNCATALOG_VERSION;
+  record.convertedTime = time(NULL);
+  ofstream catalog(filename, ios::binary | ios::app);
+  if(!catalog.is_open()) {
+    cout<<"Error in RunCatalog!!! Could not open catalog "<<filename<<" for writing"<<endl;
+    return false;
+  }
+  catalog.write((const char*)&record, sizeof(RunRecord));
+  return catalog.good();
+}
+
+//read every record; stops at the first damaged or foreign record (e.g. a write cut short)
+bool RunCatalog::read(string filename, vector<RunRecord>& records) {
+  ifstream catalog(filename, ios::binary);
+  if(!catalog.is_open()) {
+    cout<<"Error in RunCatalog!!! File "<<filename<<" either cannot be opened or doesn't exist!"<<endl;
+    return false;
+  }
+  RunRecord record;
+  while(catalog.read((char*)&record, sizeof(RunRecord))) {
+    if(record.magic != RUNCATALOG_MAGIC || record.version != RUNCATALOG_VERSION) {
+      cout<<"Error in RunCatalog!!! Bad record after "<<records.size()<<" good ones in "<<filename<<endl;
+      return false;
+    }
+    records.push_back(record);
+  }
+  return true;
+}
+
+//latest record for each run and input in the range, in catalog order
+vector<RunRecord> RunCatalog::select(const vector<RunRecord>& records, int firstRun, int lastRun) {
+  vector<RunRecord> selected;
+  for(unsigned int i=0; i<records.size(); i++) {
+    const RunRecord& record = records[i];
+    if(record.runNumber < firstRun || record.runNumber > lastRun) continue;
+    bool superseded = false;
+    for(unsigned int j=i+1; j<records.size(); j++) {
+      if(records[j].runNumber == record.runNumber && strcmp(records[j].input, record.input) == 0) {
+        superseded = true;
+        break;
+      }
+    }
+    if(!superseded) selected.push_back(record);
+  }
+  return selected;
+}
+
+void RunCatalog::print(const vector<RunRecord>& records) {
+  for(auto& record:records) {
+    time_t begin = record.beginTime;
+    char date[32] = "unknown";
+    if(begin != 0) strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&begin));
+    cout<<"-----------------------"<<endl;
+    cout<<"Run: "<<record.runNumber<<"  Title: "<<record.title<<endl;
+    cout<<"Began: "<<date<<"  Elapsed: "<<record.elapsedTime<<" s"<<endl;
+    cout<<"Input: "<<record.input<<" ("<<record.bytes<<" bytes)"<<endl;
+    cout<<"Items: "<<record.totalItems<<"  Physics: "<<record.physicsItems<<"  Scalers: "<<record.scalerItems<<endl;
+    cout<<"Integrity errors (ADC/mADC): "<<record.adcErrors<<"/"<<record.madcErrors<<endl;
+    cout<<"Entries: "<<record.entries<<" from "<<record.firstOutput<<" ["<<record.firstEntry<<"] to "
+        <<record.lastOutput<<" ["<<record.lastEntry<<")"<<endl;
+  }
+  cout<<"-----------------------"<<endl;
+}
@@ -0,0 +1,48 @@
+/*RunCatalog.h
+ *Append-only binary catalog of converted runs. evt2root appends one fixed size RunRecord per converted
+ *input (run number, title, begin/end info, item counts, integrity errors and where its entries ended up),
+ *so picking and chaining runs is a read of one small file instead of opening every rootfile. Records are
+ *only ever appended, so a later conversion of the same run just adds a newer record; readers take the 
+ *last one.
+ */
+
+#ifndef RUNCATALOG_H
+#define RUNCATALOG_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+static const uint32_t RUNCATALOG_MAGIC = 0x52554e43; //"RUNC"
+static const uint32_t RUNCATALOG_VERSION = 1;
+
+struct RunRecord {
+  uint32_t magic;
+  uint32_t version;
+  int32_t runNumber; //-1 if the input had no begin run item
+  uint32_t elapsedTime; //seconds, from the end run item
+  int64_t beginTime, endTime; //unix time from the begin/end run items, 0 if missing
+  int64_t convertedTime; //when this record was written
+  uint64_t totalItems, physicsItems, scalerItems;
+  uint64_t bytes; //size of the input's ring items
+  uint64_t adcErrors, madcErrors; //modules that failed the unpacker's word count/EOE checks
+  uint64_t entries; //DataTree entries made from this input
+  uint64_t firstEntry, lastEntry; //[firstEntry in firstOutput, lastEntry in lastOutput)
+  char title[96];
+  char input[256];
+  char firstOutput[256];
+  char lastOutput[256];
+};
+
+class RunCatalog {
+  public:
+    static bool append(string filename, RunRecord& record);
+    static bool read(string filename, vector<RunRecord>& records);
+    static vector<RunRecord> select(const vector<RunRecord>& records, int firstRun, int lastRun);
+    static void print(const vector<RunRecord>& records);
+    static void setString(char *field, size_t size, string value);
+};
+
+#endif
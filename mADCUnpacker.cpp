@@ -50,6 +50,7 @@ pair<uint32_t*, ParsedmADCEvent> mADCUnpacker::parse(uint32_t* begin, uint32_t*
 
   auto iter = begin;
   int bad_flag = 0;
+  last_errors = 0;
   unpackHeader(iter, event);
   if (iter > end){
     bad_flag =1;
@@ -61,12 +62,14 @@ pair<uint32_t*, ParsedmADCEvent> mADCUnpacker::parse(uint32_t* begin, uint32_t*
   auto dataEnd = iter + nWords;
   if (dataEnd>end) {
     bad_flag = 1;
+    last_errors |= BAD_COUNT;
     cout<<"dataEnd > end error"<<endl;
   } else {
     iter = unpackData(iter, dataEnd, event);
   }
 
   if(bad_flag || iter>end || !isEOE(*iter)) {
+    if(iter>end || !isEOE(*iter)) last_errors |= BAD_EOE;
     cout<<"mADCUpacker::parse() Unable to unpack event!"<<endl;
     cout<<"Word: "<<*iter<<endl;
   }
@@ -77,6 +80,32 @@ pair<uint32_t*, ParsedmADCEvent> mADCUnpacker::parse(uint32_t* begin, uint32_t*
 
 }
 
+//Only the word count and EOE checks of parse(), without unpacking any data; steps through
+//the buffer exactly as parse() would so a scan stays in sync with a real conversion.
+//begin must point at a module header (callers find it with isHeader())
+pair<uint32_t*, int> mADCUnpacker::validate(uint32_t* begin, uint32_t* end) {
+
+  int flags = 0;
+  auto iter = begin;
+  int nWords = ((*iter&HDR_COUNT_MASK) >> HDR_COUNT_SHIFT) - 1; //count includes the eoe
+  iter++;
+
+  auto dataEnd = iter + nWords;
+  if(nWords<0 || dataEnd>end) {
+    flags |= BAD_COUNT;
+  } else {
+    iter = dataEnd;
+  }
+
+  if(iter>=end || !isEOE(*iter)) {
+    flags |= BAD_EOE;
+  }
+  iter++;
+
+  return make_pair(iter, flags);
+
+}
+
 bool mADCUnpacker::isHeader(uint32_t word) {
   return ((word&TYPE_MASK) == TYPE_HDR);
 }
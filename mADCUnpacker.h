@@ -37,8 +37,17 @@ class mADCUnpacker {
   public:
     pair<uint32_t*, ParsedmADCEvent> parse(uint32_t* begin, uint32_t* end);
     bool isHeader(uint32_t word);
+    pair<uint32_t*, int> validate(uint32_t* begin, uint32_t* end);
+    int getErrors() { return last_errors; }; //error flags from the last parse()
+
+    //error flags returned by validate and getErrors; there is no header flag since
+    //both only ever start on a word that isHeader() accepted
+    static const int BAD_COUNT = 2;
+    static const int BAD_EOE = 4;
 
   private:
+    int last_errors;
+
     bool isData(uint32_t word);
     bool isEOE(uint32_t word); 
    
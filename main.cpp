@@ -3,15 +3,105 @@
 #include <TApplication.h>
 #include <string>
 #include <iostream>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
 using namespace std;
 
+static void printUsage() {
+  cout<<"Usage: ./evt2root [--cal=<calibration file>] [--merge[=<window>]] [--max-size=<MB>] [--max-events=<N>]"<<endl;
+  cout<<"                 [--shm=<name>[:<slots>] [--shm-force]] [--mem-budget=<MB>] [--compact]"<<endl;
+  cout<<"                 [--catalog=<catalog file>] <rootfile>"<<endl;
+  cout<<"       ./evt2root --validate"<<endl;
+  cout<<"       ./evt2root [--catalog=<catalog file>] --select=<first run>[:<last run>]"<<endl;
+}
+
+//read a whole-number option value, checking it is a number in [min, max]; complains about arg if not
+static bool parseNumber(string value, string arg, long long min, long long max, long long& result) {
+  char *end = NULL;
+  errno = 0;
+  result = strtoll(value.c_str(), &end, 10);
+  if(value.empty() || *end != '\0' || errno == ERANGE || result < min || result > max) {
+    cout<<"Bad value in command line argument: "<<arg<<" (expected a whole number from "<<min<<" to "<<max<<")"<<endl;
+    printUsage();
+    return false;
+  }
+  return true;
+}
+
 int main(int argc, char* argv[]) {
-  if(argc == 2) {
-    TApplication app("app", &argc, argv);//if someone wants root graphics
-    argv = app.Argv();
-    evt2root converter;
-    converter.run(argv[1]);
+  TApplication app("app", &argc, argv);//if someone wants root graphics
+  argv = app.Argv();
+  evt2root converter;
+  char *outname = NULL;
+  bool validate = false;
+  string selection;
+  long long value;
+  string shm_name;
+  uint32_t shm_slots = 4096;
+  bool shm_force = false;
+  for(int i=1; i<argc; i++) {
+    string arg = argv[i];
+    if(arg.compare(0, 6, "--cal=") == 0) {
+      converter.setCalibrationFile(arg.substr(6));
+    } else if(arg.compare(0, 11, "--max-size=") == 0) {
+      if(!parseNumber(arg.substr(11), arg, 1, LLONG_MAX/1000000, value)) return 1;
+      converter.setRollover(value*1000000, 0);
+    } else if(arg.compare(0, 13, "--max-events=") == 0) {
+      if(!parseNumber(arg.substr(13), arg, 1, LLONG_MAX, value)) return 1;
+      converter.setRollover(0, value);
+    } else if(arg.compare(0, 6, "--shm=") == 0) {
+      //optional slot count after a colon, e.g. --shm=encore:8192
+      shm_name = arg.substr(6);
+      size_t colon = shm_name.find(':');
+      if(colon != string::npos) {
+        if(!parseNumber(shm_name.substr(colon+1), arg, 1, UINT_MAX, value)) return 1;
+        shm_slots = value;
+        shm_name.erase(colon);
+      }
+    } else if(arg == "--shm-force") {
+      shm_force = true;
+    } else if(arg.compare(0, 13, "--mem-budget=") == 0) {
+      if(!parseNumber(arg.substr(13), arg, 1, LLONG_MAX/1000000, value)) return 1;
+      converter.setMemoryBudget(value*1000000);
+    } else if(arg.compare(0, 10, "--catalog=") == 0) {
+      converter.setCatalogFile(arg.substr(10));
+    } else if(arg.compare(0, 9, "--select=") == 0) {
+      selection = arg.substr(9);
+    } else if(arg == "--compact") {
+      converter.setCompact();
+    } else if(arg == "--validate") {
+      validate = true;
+    } else if(arg == "--merge") {
+      converter.setMergeMode(0);
+    } else if(arg.compare(0, 8, "--merge=") == 0) {
+      if(!parseNumber(arg.substr(8), arg, 0, LLONG_MAX, value)) return 1;
+      converter.setMergeMode(value);
+    } else if(outname == NULL && arg.compare(0, 2, "--") != 0) {
+      outname = argv[i];
+    } else {
+      cout<<"Unrecognized command line argument: "<<arg<<endl;
+      printUsage();
+      return 1;
+    }
+  }
+  if(!shm_name.empty()) converter.setSharedMemory(shm_name, shm_slots, shm_force);
+  if(!selection.empty()) {
+    //catalog query: --select=<first run>:<last run>, or a single run
+    size_t colon = selection.find(':');
+    long long firstRun, lastRun;
+    if(!parseNumber(selection.substr(0, colon), "--select=" + selection, 0, INT_MAX, firstRun)) return 1;
+    lastRun = firstRun;
+    if(colon != string::npos && !parseNumber(selection.substr(colon+1), "--select=" + selection, 0, INT_MAX, lastRun)) return 1;
+    vector<RunRecord> records;
+    RunCatalog::read(converter.getCatalogFile(), records);
+    RunCatalog::print(RunCatalog::select(records, firstRun, lastRun));
+  } else if(validate) {
+    converter.validate();
+  } else if(outname != NULL) {
+    converter.run(outname);
   } else {
     cout<<"Incorrect number of command line arguments!! Needs fullpath of rootfile"<<endl;
+    printUsage();
   }
 }